@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <lzw.hpp>
+
+
+/// Heap accounting of the whole process: every allocation carries its size
+namespace heap {
+    
+    std::atomic<std::size_t> allocations{0};
+    std::atomic<std::size_t> live{0};
+    std::atomic<std::size_t> peak{0};
+    
+    constexpr std::size_t header = 16; // keeps max_align_t alignment
+    
+    /// Starts measurement: peak is counted from current live bytes
+    void reset() {
+        allocations = 0;
+        peak = live.load();
+    }
+}
+
+void* operator new(std::size_t size) {
+    auto p = static_cast<unsigned char*>(std::malloc(size + heap::header));
+    if(p == nullptr) throw std::bad_alloc{};
+    
+    std::memcpy(p, &size, sizeof(size));
+    ++heap::allocations;
+    const std::size_t live = heap::live += size;
+    for(std::size_t peak = heap::peak; live > peak && !heap::peak.compare_exchange_weak(peak, live);) {}
+    
+    return p + heap::header;
+}
+
+void operator delete(void* ptr) noexcept {
+    if(ptr == nullptr) return;
+    
+    auto p = static_cast<unsigned char*>(ptr) - heap::header;
+    std::size_t size = 0;
+    std::memcpy(&size, p, sizeof(size));
+    heap::live -= size;
+    std::free(p);
+}
+
+
+/// Deterministic corpus generators, every one is ASCII except binary
+namespace corpus {
+    
+    using rng_t = std::mt19937;
+    
+    /// English-like text: Zipf-distributed words, punctuation, lines
+    std::string text(std::size_t length, rng_t& rng) {
+        static const char* words[] = {"the", "of", "and", "to", "in", "a", "is", "that", "for", "it",
+            "as", "was", "with", "be", "by", "on", "not", "he", "this", "are", "or", "his", "from",
+            "at", "which", "but", "have", "an", "had", "they", "you", "were", "their", "one", "all",
+            "we", "can", "her", "has", "there", "been", "if", "more", "when", "will", "would", "who",
+            "so", "no", "compression", "dictionary", "symbol", "stream", "algorithm", "message"};
+        constexpr std::size_t count = sizeof(words)/sizeof(words[0]);
+        
+        std::string out;
+        while(out.size() < length) {
+            // rank ~ 1/x
+            const double x = std::uniform_real_distribution<double>(0, std::log(double(count)))(rng);
+            out += words[std::min(count - 1, std::size_t(std::exp(x)) - 1)];
+            
+            const auto p = rng() % 32;
+            out += p == 0 ? ".\n" : p == 1 ? ", " : " ";
+        }
+        out.resize(length);
+        return out;
+    }
+    
+    /// JSON records of the same schema
+    std::string json(std::size_t length, rng_t& rng) {
+        static const char* names[] = {"alice", "bob", "carol", "dave", "eve", "mallory"};
+        static const char* states[] = {"active", "pending", "closed"};
+        
+        std::string out;
+        while(out.size() < length) {
+            out += "{\"id\":" + std::to_string(rng() % 1000000) + ",\"user\":\"" + names[rng() % 6] +
+                "\",\"state\":\"" + states[rng() % 3] + "\",\"items\":[";
+            for(std::size_t i = 0, n = rng() % 4 + 1; i < n; ++i)
+                out += "{\"sku\":\"SKU-" + std::to_string(rng() % 10000) + "\",\"qty\":" +
+                    std::to_string(rng() % 10) + "},";
+            out += "{}]}\n";
+        }
+        out.resize(length);
+        return out;
+    }
+    
+    /// Service log lines: growing timestamps, levels, modules, ids
+    std::string logs(std::size_t length, rng_t& rng) {
+        static const char* levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+        static const char* modules[] = {"http", "db", "cache", "auth", "scheduler"};
+        static const char* events[] = {"request served", "query executed", "miss, fetching",
+            "token refreshed", "job started", "connection reset by peer"};
+        
+        std::string out;
+        for(std::size_t ts = 1500000000000; out.size() < length; ts += rng() % 1000) {
+            const auto e = rng() % 6;
+            out += std::to_string(ts) + " " + levels[rng() % 6] + " [" + modules[e % 5] + "] " +
+                events[e] + " id=" + std::to_string(rng() % 100000) + " took=" + std::to_string(rng() % 500) + "ms\n";
+        }
+        out.resize(length);
+        return out;
+    }
+    
+    /// Binary: little-endian counters, small-range samples, zero runs and noise
+    std::string binary(std::size_t length, rng_t& rng) {
+        std::string out;
+        for(std::uint32_t counter = 0; out.size() < length; ++counter) {
+            switch(rng() % 4) {
+                case 0:
+                    for(std::size_t i = 0; i < 4; ++i)
+                        out += char((counter >> (8*i)) & 0xFF);
+                    break;
+                case 1:
+                    out += char(128 + rng() % 16);
+                    break;
+                case 2:
+                    out.append(rng() % 32, '\0');
+                    break;
+                default:
+                    out += char(rng());
+                    break;
+            }
+        }
+        out.resize(length);
+        return out;
+    }
+}
+
+
+/// Benchmark of all predefined codecs over corpus, one JSON object per line:
+/// bench [--max-size BYTES] [--min-time SECONDS] [--file PATH]...
+struct options {
+    std::size_t max_size = std::size_t(1) << 24;
+    double min_time = 0.2;
+    std::vector<std::string> files;
+};
+
+struct sample {
+    std::string name;
+    std::string data;
+};
+
+/// Measured call: seconds per call, allocations per call, peak heap bytes during one call
+struct measurement {
+    double seconds;
+    double allocations;
+    std::size_t peak_heap;
+};
+
+template <class Fun>
+measurement measure(Fun const& fun, double min_time) {
+    using clock_t = std::chrono::steady_clock;
+    
+    // the first call: allocations and peak heap of cold call
+    const std::size_t base = heap::live;
+    heap::reset();
+    auto t1 = clock_t::now();
+    fun();
+    auto t2 = clock_t::now();
+    const double allocations = double(heap::allocations);
+    const std::size_t peak_heap = heap::peak - base;
+    
+    // the rest: time only
+    double seconds = std::chrono::duration<double>(t2 - t1).count();
+    std::size_t calls = 1;
+    while(seconds < min_time) {
+        const std::size_t batch = std::max<std::size_t>(1, calls);
+        t1 = clock_t::now();
+        for(std::size_t i = 0; i < batch; ++i)
+            fun();
+        t2 = clock_t::now();
+        seconds += std::chrono::duration<double>(t2 - t1).count();
+        calls += batch;
+    }
+    
+    return measurement{seconds/calls, allocations, peak_heap};
+}
+
+long max_rss_kb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+template <class Codec>
+bool run_codec(char const* codec_name, std::vector<sample> const& samples, options const& opt) {
+    using src_t  = std::vector<typename Codec::Input_dictionary::value_type>;
+    using pack_t = std::vector<typename Codec:: Pack_dictionary::value_type>;
+    
+    for(auto const& s : samples) {
+        // input symbols have to belong to Input_dictionary
+        const bool valid = std::all_of(s.data.begin(), s.data.end(), [](char c) {
+            return Codec::Input_dictionary::find_index(typename Codec::Input_dictionary::value_type(c)) !=
+                Codec::Input_dictionary::length; });
+        if(!valid) continue;
+        
+        const src_t src(s.data.begin(), s.data.end());
+        const double megabytes = double(src.size()*sizeof(typename src_t::value_type))/(1 << 20);
+        
+        for(auto const format : {"legacy", "stream"}) {
+            const bool legacy = format[0] == 'l';
+            pack_t enc;
+            src_t dec;
+            
+            const auto encoding = measure([&] {
+                enc.clear();
+                enc.shrink_to_fit();
+                if(legacy) Codec::encode(src.begin(), src.end(), std::back_inserter(enc));
+                else Codec::encode(src.begin(), src.end(), std::back_inserter(enc), lzw::stream_options{});
+            }, opt.min_time);
+            
+            const auto decoding = measure([&] {
+                dec.clear();
+                dec.shrink_to_fit();
+                Codec::decode(enc.begin(), enc.end(), std::back_inserter(dec));
+            }, opt.min_time);
+            
+            if(dec != src) {
+                std::fprintf(stderr, "%s %s %s: round trip failed\n", codec_name, s.name.c_str(), format);
+                return false;
+            }
+            
+            const double ratio = double(enc.size()*sizeof(typename pack_t::value_type))/
+                double(src.size()*sizeof(typename src_t::value_type));
+            
+            std::printf("{\"codec\":\"%s\",\"corpus\":\"%s\",\"size\":%zu,\"format\":\"%s\","
+                "\"encode_mbps\":%.2f,\"decode_mbps\":%.2f,\"ratio\":%.4f,"
+                "\"encode_allocs\":%.0f,\"decode_allocs\":%.0f,"
+                "\"encode_peak_heap\":%zu,\"decode_peak_heap\":%zu,\"max_rss_kb\":%ld}\n",
+                codec_name, s.name.c_str(), src.size(), format,
+                megabytes/encoding.seconds, megabytes/decoding.seconds, ratio,
+                encoding.allocations, decoding.allocations,
+                encoding.peak_heap, decoding.peak_heap, max_rss_kb());
+            std::fflush(stdout);
+        }
+    }
+    
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    
+    options opt;
+    for(int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if(arg == "--max-size" && i + 1 < argc)
+            opt.max_size = std::strtoull(argv[++i], nullptr, 10);
+        else if(arg == "--min-time" && i + 1 < argc)
+            opt.min_time = std::strtod(argv[++i], nullptr);
+        else if(arg == "--file" && i + 1 < argc)
+            opt.files.push_back(argv[++i]);
+        else {
+            std::fprintf(stderr, "Usage: %s [--max-size BYTES] [--min-time SECONDS] [--file PATH]...\n"
+                "  sizes are 64 B * 16^k up to max-size (default 16 MB, up to 1 GB),\n"
+                "  files (e.g. Canterbury/Silesia corpus) are measured at their own size\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    
+    // every corpus of every size, then given files
+    std::vector<sample> samples;
+    using generator_t = std::string (*)(std::size_t, corpus::rng_t&);
+    const std::pair<char const*, generator_t> generators[] = {
+        {"text", corpus::text}, {"json", corpus::json}, {"logs", corpus::logs}, {"binary", corpus::binary}};
+    
+    for(std::size_t size = 64; size <= opt.max_size && size <= (std::size_t(1) << 30); size *= 16)
+        for(auto const& g : generators) {
+            corpus::rng_t rng{7};
+            samples.push_back(sample{g.first, g.second(size, rng)});
+        }
+    
+    for(auto const& path : opt.files) {
+        std::ifstream in(path, std::ios::binary);
+        if(!in) {
+            std::fprintf(stderr, "Can't read %s\n", path.c_str());
+            return EXIT_FAILURE;
+        }
+        samples.push_back(sample{path, std::string{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()}});
+    }
+    
+    using namespace lzw::codecs;
+    const bool ok =
+        run_codec<string_to_string>("string_to_string", samples, opt) &&
+        run_codec<binary_to_binary>("binary_to_binary", samples, opt) &&
+        run_codec<string_to_UTF16> ("string_to_UTF16",  samples, opt) &&
+        run_codec<string_to_URI>   ("string_to_URI",    samples, opt) &&
+        run_codec<UTF16_to_binary> ("UTF16_to_binary",  samples, opt);
+    
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
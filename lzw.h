@@ -0,0 +1,86 @@
+#ifndef AX_LZW_H
+#define AX_LZW_H
+
+#include <stddef.h>
+
+/* Stable C ABI of predefined codecs (shared library AX_LZW), e.g. for Go, Rust or Python ctypes.
+   Context owns dictionaries and buffers of one codec, they are kept warm between calls.
+   Context is not thread-safe: one context per thread. Nothing throws across the boundary. */
+   
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LZW_ABI_VERSION 1
+
+#if defined(_WIN32) && defined(AX_LZW_BUILD)
+#define LZW_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define LZW_API __declspec(dllimport)
+#else
+#define LZW_API __attribute__((visibility("default")))
+#endif
+
+/* Codec ids, symbol types of input (uncompressed) => packed (compressed) data.
+   Sizes of calls (n, cap, *written) count symbols of these types, not bytes:
+   n of LZW_UTF16_TO_BINARY input is amount of uint16_t values. */
+enum lzw_codec_id {
+    LZW_BINARY_TO_BINARY = 0,   /* uint8_t  => uint8_t  */
+    LZW_STRING_TO_STRING = 1,   /* char (ASCII) => char (ASCII) */
+    LZW_STRING_TO_UTF16  = 2,   /* char (ASCII) => uint16_t (UTF16 printable) */
+    LZW_STRING_TO_URI    = 3,   /* char (ASCII) => char [0-9A-Za-z] */
+    LZW_UTF16_TO_BINARY  = 4    /* uint16_t => uint8_t */
+};
+
+/* Status of call: decoding failures are the same as lzw::decode_status */
+enum lzw_status {
+    LZW_OK = 0,
+    LZW_TRUNCATED,
+    LZW_BAD_HEADER,
+    LZW_UNKNOWN_CODE_MODE,
+    LZW_UNSUPPORTED_BIT_DEPTH,
+    LZW_UNKNOWN_SEED,
+    LZW_BAD_SEED,
+    LZW_BAD_PACKED_SYMBOL,
+    LZW_BAD_CODE,
+    LZW_OUTPUT_OVERFLOW,        /* dst is too small, see *written */
+    LZW_LENGTH_MISMATCH,
+    LZW_CHECKSUM_MISMATCH,
+    LZW_BAD_INPUT_SYMBOL = 64,  /* encoding input symbol is out of input dictionary */
+    LZW_BAD_ARGUMENT,
+    LZW_NO_MEMORY
+};
+
+typedef struct lzw_ctx lzw_ctx;
+
+/* @returns LZW_ABI_VERSION of the library */
+LZW_API int lzw_abi_version(void);
+
+/* @returns new context of codec_id, NULL if it's unknown or memory is exhausted */
+LZW_API lzw_ctx* lzw_ctx_create(int codec_id);
+
+/* Releases context, NULL is ignored */
+LZW_API void lzw_ctx_destroy(lzw_ctx* ctx);
+
+/* @returns upper bound of lzw_encode output (packed symbols) for n input symbols */
+LZW_API size_t lzw_max_encoded_size(lzw_ctx const* ctx, size_t n);
+
+/* Compresses n input symbols of src into dst of cap packed symbols (extended format stream,
+   no allocations in steady state). cap >= lzw_max_encoded_size(ctx, n) always fits,
+   dst may be NULL if cap is 0.
+   *written is amount of packed symbols written (0 on failure). */
+LZW_API int lzw_encode(lzw_ctx* ctx, void const* src, size_t n, void* dst, size_t cap, size_t* written);
+
+/* Decompresses n packed symbols of src (both formats) into dst of cap input symbols,
+   dst may be NULL if cap is 0.
+   *written is amount of symbols written: decoded prefix on failure, LZW_OUTPUT_OVERFLOW at most cap. */
+LZW_API int lzw_decode(lzw_ctx* ctx, void const* src, size_t n, void* dst, size_t cap, size_t* written);
+
+/* @returns static description of status */
+LZW_API char const* lzw_status_message(int status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AX_LZW_H */
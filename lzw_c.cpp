@@ -0,0 +1,126 @@
+#include <exception>
+#include <new>
+#include <stdexcept>
+
+#include <lzw.h>
+#include <lzw.hpp>
+
+
+/// Context of any codec: C calls are dispatched by virtual functions
+struct lzw_ctx {
+    virtual ~lzw_ctx() = default;
+    virtual size_t max_encoded_size(size_t n) const = 0;
+    virtual int encode(void const* src, size_t n, void* dst, size_t cap, size_t& written) = 0;
+    virtual int decode(void const* src, size_t n, void* dst, size_t cap, size_t& written) = 0;
+};
+
+namespace {
+    
+    /// Context of Codec: workspaces are reused by every call
+    template <class Codec>
+    class codec_ctx final : public lzw_ctx { private:
+        
+        using value_type  = typename Codec::Input_dictionary::value_type;
+        using packed_type = typename Codec::Pack_dictionary::value_type;
+        
+        typename Codec::encode_workspace encoder_;
+        typename Codec::decode_workspace decoder_;
+        
+    public:
+        
+        size_t max_encoded_size(size_t n) const override {
+            return Codec::max_encoded_size(n); }
+        
+        int encode(void const* src, size_t n, void* dst, size_t cap, size_t& written) override {
+            auto const first = static_cast<value_type const*>(src);
+            auto const d_first = static_cast<packed_type*>(dst);
+            written = size_t(Codec::encode_into(first, first + n, d_first, cap, encoder_) - d_first);
+            return LZW_OK;
+        }
+        
+        int decode(void const* src, size_t n, void* dst, size_t cap, size_t& written) override {
+            auto const first = static_cast<packed_type const*>(src);
+            auto const d_first = static_cast<value_type*>(dst);
+            const auto result = Codec::try_decode_into(first, first + n, d_first, d_first + cap, decoder_);
+            written = size_t(result.out - d_first);
+            return int(result.status);
+        }
+    };
+    
+    /// Runs call, exceptions become status: encoding throws on bad input symbol (symbol lookup
+    /// std::out_of_range) and output overflow, any other error is reported as bad argument
+    template <class Call>
+    int guarded(Call const& call) {
+        try {
+            return call();
+        } catch(std::length_error const&) {
+            return LZW_OUTPUT_OVERFLOW;
+        } catch(std::bad_alloc const&) {
+            return LZW_NO_MEMORY;
+        } catch(std::out_of_range const&) {
+            return LZW_BAD_INPUT_SYMBOL;
+        } catch(...) {
+            return LZW_BAD_ARGUMENT;
+        }
+    }
+}
+
+
+extern "C" {
+
+int lzw_abi_version(void) {
+    return LZW_ABI_VERSION;
+}
+
+lzw_ctx* lzw_ctx_create(int codec_id) {
+    using namespace lzw::codecs;
+    
+    // workspaces allocate while constructed
+    try {
+        switch(codec_id) {
+            case LZW_BINARY_TO_BINARY:  return new codec_ctx<binary_to_binary>{};
+            case LZW_STRING_TO_STRING:  return new codec_ctx<string_to_string>{};
+            case LZW_STRING_TO_UTF16:   return new codec_ctx<string_to_UTF16>{};
+            case LZW_STRING_TO_URI:     return new codec_ctx<string_to_URI>{};
+            case LZW_UTF16_TO_BINARY:   return new codec_ctx<UTF16_to_binary>{};
+        }
+    } catch(...) {}
+    return nullptr;
+}
+
+void lzw_ctx_destroy(lzw_ctx* ctx) {
+    delete ctx;
+}
+
+size_t lzw_max_encoded_size(lzw_ctx const* ctx, size_t n) {
+    return ctx != nullptr ? ctx->max_encoded_size(n) : 0;
+}
+
+int lzw_encode(lzw_ctx* ctx, void const* src, size_t n, void* dst, size_t cap, size_t* written) {
+    if(written != nullptr) *written = 0;
+    if(ctx == nullptr || written == nullptr || (src == nullptr && n != 0) || (dst == nullptr && cap != 0))
+        return LZW_BAD_ARGUMENT;
+    
+    return guarded([&] { return ctx->encode(src, n, dst, cap, *written); });
+}
+
+int lzw_decode(lzw_ctx* ctx, void const* src, size_t n, void* dst, size_t cap, size_t* written) {
+    if(written != nullptr) *written = 0;
+    if(ctx == nullptr || written == nullptr || (src == nullptr && n != 0) || (dst == nullptr && cap != 0))
+        return LZW_BAD_ARGUMENT;
+    
+    return guarded([&] { return ctx->decode(src, n, dst, cap, *written); });
+}
+
+char const* lzw_status_message(int status) {
+    switch(status) {
+        case LZW_BAD_INPUT_SYMBOL:  return "lzw_codec: symbol doesn't belong to input dictionary";
+        case LZW_BAD_ARGUMENT:      return "lzw_codec: bad argument";
+        case LZW_NO_MEMORY:         return "lzw_codec: out of memory";
+    }
+    if(status < LZW_OK || status > LZW_CHECKSUM_MISMATCH)
+        return "lzw_codec: unknown status";
+    return lzw::status_message(lzw::decode_status(status));
+}
+
+}
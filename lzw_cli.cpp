@@ -0,0 +1,30 @@
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+#include <lzw_file.hpp>
+
+/// Command line front end: lzw (c|d) <input> <output>
+int main(int argc, char* argv[]) {
+    
+    using codec = lzw::file_codec<lzw::codecs::binary_to_binary>;
+    
+    if(argc != 4 || (std::strcmp(argv[1], "c") != 0 && std::strcmp(argv[1], "d") != 0)) {
+        std::cerr << "Usage: " << argv[0] << " (c|d) <input> <output>\n"
+                  << "  c - compress, d - decompress" << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    try {
+        if(argv[1][0] == 'c')
+            codec::encode(argv[2], argv[3]);
+        else
+            codec::decode(argv[2], argv[3]);
+    } catch(std::exception const& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
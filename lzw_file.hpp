@@ -0,0 +1,222 @@
+#pragma once
+
+#include <lzw.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace lzw {
+    
+    /// Implementation details
+    namespace details {
+        
+        /// Read-only memory mapped file, sequential access hint
+        class mapped_file { private:
+            
+            int fd_ = -1;
+            void* data_ = nullptr;
+            size_t size_ = 0;
+            
+            [[noreturn]] static void fail(std::string const& what, int error = errno) {
+                throw std::system_error{error, std::generic_category(), "lzw_file: " + what}; }
+                
+        public:
+            
+            explicit mapped_file(std::string const& path) {
+                fd_ = ::open(path.c_str(), O_RDONLY);
+                if(fd_ < 0) fail("can't open " + path);
+                
+                struct stat st;
+                if(::fstat(fd_, &st) != 0) {
+                    const int error = errno;
+                    ::close(fd_);
+                    fail("can't stat " + path, error);
+                }
+                
+                // empty file can't be mapped
+                size_ = size_t(st.st_size);
+                if(size_ == 0) return;
+                
+                data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+                if(data_ == MAP_FAILED) {
+                    const int error = errno;
+                    ::close(fd_);
+                    fail("can't map " + path, error);
+                }
+                
+                ::madvise(data_, size_, MADV_SEQUENTIAL);
+            }
+            
+            mapped_file(mapped_file const&) = delete;
+            mapped_file& operator=(mapped_file const&) = delete;
+            
+            ~mapped_file() {
+                if(data_ != nullptr) ::munmap(data_, size_);
+                if(fd_ >= 0) ::close(fd_);
+            }
+            
+            /// Drops already processed pages [0, offset) from memory
+            void release(size_t offset) {
+                const size_t page = size_t(::sysconf(_SC_PAGESIZE));
+                if(data_ != nullptr && offset >= page)
+                    ::madvise(data_, offset/page*page, MADV_DONTNEED);
+            }
+            
+            unsigned char const* data() const {
+                return static_cast<unsigned char const*>(data_); }
+            
+            size_t size() const {
+                return size_; }
+        };
+        
+        /// Binary output file written by chunks
+        class chunked_file { private:
+            
+            std::ofstream out_;
+            size_t largest_write_ = 0;
+            
+        public:
+            
+            explicit chunked_file(std::string const& path) {
+                out_.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                out_.open(path, std::ios::binary | std::ios::trunc);
+            }
+            
+            /// Writes and clears buffer
+            template <class T>
+            void write(std::vector<T>& buffer) {
+                static_assert(sizeof(T) == 1, "chunked_file: byte buffer is required");
+                out_.write(reinterpret_cast<char const*>(buffer.data()), std::streamsize(buffer.size()));
+                largest_write_ = std::max(largest_write_, buffer.size());
+                buffer.clear();
+            }
+            
+            void close() {
+                out_.close(); }
+            
+            /// @returns the largest buffer written, bytes
+            size_t largest_write() const {
+                return largest_write_; }
+        };
+        
+        /// Output iterator appending to buffer, full buffer (chunk symbols) is written to file
+        template <class T>
+        class chunked_inserter { private:
+            
+            std::vector<T>* buffer_;
+            chunked_file* file_;
+            size_t chunk_;
+            
+        public:
+            
+            using iterator_category = std::output_iterator_tag;
+            using value_type        = void;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = void;
+            using reference         = void;
+            
+            chunked_inserter(std::vector<T>& buffer, chunked_file& file, size_t chunk) :
+                buffer_{&buffer}, file_{&file}, chunk_{chunk} {}
+            
+            chunked_inserter& operator=(T const& value) {
+                buffer_->push_back(value);
+                if(buffer_->size() >= chunk_)
+                    file_->write(*buffer_);
+                return *this;
+            }
+            
+            chunked_inserter& operator*() { return *this; }
+            chunked_inserter& operator++() { return *this; }
+            chunked_inserter& operator++(int) { return *this; }
+        };
+        
+        
+        /// File-level front end of byte-oriented Codec: input is memory mapped,
+        /// output is written through streaming codec by chunks, memory is flat
+        /// (legacy format decoding keeps codes of the whole message).
+        template <class Codec>
+        class file_codec { private:
+            
+            using value_type  = typename Codec::Input_dictionary::value_type;
+            using packed_type = typename Codec::Pack_dictionary::value_type;
+            
+            static_assert(sizeof(value_type) == 1 && sizeof(packed_type) == 1,
+                "file_codec: byte-oriented Codec is required");
+                
+        public:
+            
+            /// Input bytes per streaming step
+            constexpr static size_t chunk_size = size_t(1) << 20;
+            
+            /// Compresses file src_path into dst_path (extended format)
+            static void encode(std::string const& src_path, std::string const& dst_path,
+                stream_options const& options = stream_options{}) {
+                mapped_file src{src_path};
+                chunked_file dst{dst_path};
+                
+                stream_encoder<Codec> encoder{options};
+                std::vector<packed_type> buffer;
+                
+                auto const data = reinterpret_cast<value_type const*>(src.data());
+                for(size_t offset = 0; offset < src.size(); offset += chunk_size) {
+                    const size_t chunk = constexpr_min(chunk_size, src.size() - offset);
+                    encoder.write(data + offset, data + offset + chunk, std::back_inserter(buffer));
+                    dst.write(buffer);
+                    src.release(offset + chunk);
+                }
+                
+                encoder.finish(std::back_inserter(buffer));
+                dst.write(buffer);
+                dst.close();
+            }
+            
+            /// Decompresses file src_path into dst_path, both formats are accepted
+            static void decode(std::string const& src_path, std::string const& dst_path) {
+                mapped_file src{src_path};
+                chunked_file dst{dst_path};
+                decode(src, dst);
+            }
+            
+            /// Decompresses src into dst, output is written by chunk_size bytes at most
+            static void decode(mapped_file& src, chunked_file& dst) {
+                std::vector<value_type> buffer;
+                buffer.reserve(chunk_size);
+                chunked_inserter<value_type> out{buffer, dst, chunk_size};
+                
+                auto const data = reinterpret_cast<packed_type const*>(src.data());
+                
+                // legacy format message is unpacked at once, its phrases are written by chunks
+                if(src.size() != 0 && symbol_lookup<typename Codec::Pack_dictionary>::index_of_symbol(data[0]) != 0) {
+                    Codec::decode(data, data + src.size(), out);
+                } else {
+                    stream_decoder<Codec> decoder;
+                    for(size_t offset = 0; offset < src.size(); offset += chunk_size) {
+                        const size_t chunk = constexpr_min(chunk_size, src.size() - offset);
+                        decoder.write(data + offset, data + offset + chunk, out);
+                        src.release(offset + chunk);
+                    }
+                    decoder.finish();
+                }
+                
+                dst.write(buffer);
+                dst.close();
+            }
+        };
+    }
+    
+    
+    using details::      file_codec;    // File-level front end: file_codec<Codec>::encode/decode
+    
+} // lzw
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <emscripten/bind.h>
+#include <emscripten/val.h>
+
+#include <lzw.hpp>
+
+
+/// Embind module: codec instances over buffers of WASM heap. JS fills input through typed array
+/// view returned by input(size), every call returns view of output buffer (null on failure, see
+/// message()). Views are valid until the next call of the same instance and heap growth.
+/// Instances keep dictionaries and buffers between calls, nothing is copied across JS boundary
+/// except the input itself. Module is built without exceptions (no -fexceptions/DISABLE_EXCEPTION_CATCHING
+/// in AX_LZW_WASM LINK_FLAGS), any throw aborts it: every argument and input is validated before
+/// codec calls, corrupt packed input is reported by try_ calls whose symbol lookups don't throw.
+namespace binding {
+    
+    using lzw::size_t;
+    
+    /// @returns typed array view of buffer: char/unsigned char => Uint8Array, char16_t => Uint16Array
+    template <class T>
+    emscripten::val view(std::vector<T> const& buffer) {
+        using unsigned_type = typename std::make_unsigned<T>::type;
+        return emscripten::val(emscripten::typed_memory_view(buffer.size(),
+            reinterpret_cast<unsigned_type const*>(buffer.data())));
+    }
+    
+    /// @returns true if every symbol belongs to Dict (encoding of others would abort)
+    template <class Dict, class T>
+    bool valid_input(std::vector<T> const& input) {
+        return std::all_of(input.begin(), input.end(), [](T c) {
+            return Dict::find_index(c) != Dict::length; });
+    }
+    
+    constexpr char const* bad_input = "lzw_codec: symbol doesn't belong to input dictionary";
+    
+    
+    /// Whole messages, legacy format
+    template <class Codec>
+    class message_encoder { private:
+        
+        using value_type  = typename Codec::Input_dictionary::value_type;
+        using packed_type = typename Codec::Pack_dictionary::value_type;
+        
+        typename Codec::encode_workspace ws_;
+        std::vector<value_type> input_;
+        std::vector<packed_type> output_;
+        bool ok_ = true;
+        
+    public:
+        
+        emscripten::val input(size_t size) {
+            input_.resize(size);
+            return view(input_);
+        }
+        
+        /// Encodes the whole input buffer
+        emscripten::val encode() {
+            output_.clear();
+            ok_ = valid_input<typename Codec::Input_dictionary>(input_);
+            if(!ok_) return emscripten::val::null();
+            
+            Codec::encode(input_.data(), input_.data() + input_.size(), std::back_inserter(output_), ws_);
+            return view(output_);
+        }
+        
+        std::string message() const {
+            return ok_ ? lzw::status_message(lzw::decode_status::ok) : bad_input; }
+    };
+    
+    /// Whole messages of both formats
+    template <class Codec>
+    class message_decoder { private:
+        
+        using value_type  = typename Codec::Input_dictionary::value_type;
+        using packed_type = typename Codec::Pack_dictionary::value_type;
+        
+        typename Codec::decode_workspace ws_;
+        std::vector<packed_type> input_;
+        std::vector<value_type> output_;
+        lzw::decode_status status_ = lzw::decode_status::ok;
+        
+    public:
+        
+        emscripten::val input(size_t size) {
+            input_.resize(size);
+            return view(input_);
+        }
+        
+        /// Decodes the whole input buffer, corrupt input is reported by status()
+        emscripten::val decode() {
+            output_.clear();
+            status_ = Codec::try_decode(input_.data(), input_.data() + input_.size(),
+                std::back_inserter(output_), ws_).status;
+            return status_ == lzw::decode_status::ok ? view(output_) : emscripten::val::null();
+        }
+        
+        int status() const {
+            return int(status_); }
+        
+        std::string message() const {
+            return lzw::status_message(status_); }
+    };
+    
+    /// Extended format stream by chunks
+    template <class Codec>
+    class stream_encoder { private:
+        
+        using value_type  = typename Codec::Input_dictionary::value_type;
+        using packed_type = typename Codec::Pack_dictionary::value_type;
+        
+        char const* options_error_ = nullptr;   // constructor arguments are unsupported, every call fails
+        lzw::stream_encoder<Codec> encoder_;
+        std::vector<value_type> input_;
+        std::vector<packed_type> output_;
+        bool ok_ = true;
+        
+        static lzw::stream_options make_options(size_t max_bit_depth, bool checksum) {
+            lzw::stream_options options;
+            options.max_bit_depth = max_bit_depth;
+            options.checksum = checksum;
+            return options;
+        }
+        
+    public:
+        
+        stream_encoder() = default;
+        
+        /// @param max_bit_depth - dictionary limit, 0 == codec default
+        /// Unsupported arguments are reported by message(), the instance returns null then.
+        stream_encoder(size_t max_bit_depth, bool checksum) :
+            options_error_{Codec::options_error(make_options(max_bit_depth, checksum))},
+            encoder_{options_error_ ? lzw::stream_options{} : make_options(max_bit_depth, checksum)} {}
+        
+        emscripten::val input(size_t size) {
+            input_.resize(size);
+            return view(input_);
+        }
+        
+        /// Encodes the whole input buffer as continuation of stream
+        emscripten::val write() {
+            output_.clear();
+            ok_ = valid_input<typename Codec::Input_dictionary>(input_);
+            if(!ok_ || options_error_) return emscripten::val::null();
+            
+            encoder_.write(input_.data(), input_.data() + input_.size(), std::back_inserter(output_));
+            return view(output_);
+        }
+        
+        emscripten::val flush() {
+            output_.clear();
+            if(options_error_) return emscripten::val::null();
+            encoder_.flush(std::back_inserter(output_));
+            return view(output_);
+        }
+        
+        /// Terminates stream, the next write starts a new one
+        emscripten::val finish() {
+            output_.clear();
+            if(options_error_) return emscripten::val::null();
+            encoder_.finish(std::back_inserter(output_));
+            return view(output_);
+        }
+        
+        std::string message() const {
+            return options_error_ ? options_error_ : ok_ ? lzw::status_message(lzw::decode_status::ok) : bad_input; }
+    };
+    
+    /// Extended format streams by chunks, concatenated streams are decoded one by one
+    template <class Codec>
+    class stream_decoder { private:
+        
+        using value_type  = typename Codec::Input_dictionary::value_type;
+        using packed_type = typename Codec::Pack_dictionary::value_type;
+        
+        lzw::stream_decoder<Codec> decoder_;
+        std::vector<packed_type> input_;
+        std::vector<value_type> output_;
+        lzw::decode_status status_ = lzw::decode_status::ok;
+        
+    public:
+        
+        emscripten::val input(size_t size) {
+            input_.resize(size);
+            return view(input_);
+        }
+        
+        /// Decodes the whole input buffer as continuation of stream(s), corrupt input is reported by status().
+        /// Stream state is undefined after failure, a new instance has to be used.
+        emscripten::val write() {
+            output_.clear();
+            status_ = decoder_.try_write(input_.data(), input_.data() + input_.size(),
+                std::back_inserter(output_)).status;
+            return status_ == lzw::decode_status::ok ? view(output_) : emscripten::val::null();
+        }
+        
+        /// @returns true if the last stream has been terminated
+        bool finish() {
+            if(status_ == lzw::decode_status::ok)
+                status_ = decoder_.try_finish();
+            return status_ == lzw::decode_status::ok;
+        }
+        
+        int status() const {
+            return int(status_); }
+        
+        std::string message() const {
+            return lzw::status_message(status_); }
+    };
+    
+    
+    /// Registers {name}Encoder, {name}Decoder, {name}StreamEncoder, {name}StreamDecoder classes of Codec
+    template <class Codec>
+    void register_codec(std::string const& name) {
+        using namespace emscripten;
+        
+        class_<message_encoder<Codec>>((name + "Encoder").c_str())
+            .template constructor<>()
+            .function("input", &message_encoder<Codec>::input)
+            .function("encode", &message_encoder<Codec>::encode)
+            .function("message", &message_encoder<Codec>::message);
+        
+        class_<message_decoder<Codec>>((name + "Decoder").c_str())
+            .template constructor<>()
+            .function("input", &message_decoder<Codec>::input)
+            .function("decode", &message_decoder<Codec>::decode)
+            .function("status", &message_decoder<Codec>::status)
+            .function("message", &message_decoder<Codec>::message);
+        
+        class_<stream_encoder<Codec>>((name + "StreamEncoder").c_str())
+            .template constructor<>()
+            .template constructor<size_t, bool>()
+            .function("input", &stream_encoder<Codec>::input)
+            .function("write", &stream_encoder<Codec>::write)
+            .function("flush", &stream_encoder<Codec>::flush)
+            .function("finish", &stream_encoder<Codec>::finish)
+            .function("message", &stream_encoder<Codec>::message);
+        
+        class_<stream_decoder<Codec>>((name + "StreamDecoder").c_str())
+            .template constructor<>()
+            .function("input", &stream_decoder<Codec>::input)
+            .function("write", &stream_decoder<Codec>::write)
+            .function("finish", &stream_decoder<Codec>::finish)
+            .function("status", &stream_decoder<Codec>::status)
+            .function("message", &stream_decoder<Codec>::message);
+    }
+}
+
+
+EMSCRIPTEN_BINDINGS(lzw) {
+    binding::register_codec<lzw::codecs::string_to_UTF16> ("UTF16");
+    binding::register_codec<lzw::codecs::binary_to_binary>("Binary");
+}
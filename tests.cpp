@@ -1,16 +1,19 @@
 #include <algorithm>
-#include <chrono>
-#include <cmath>
 #include <cstddef>
-#include <cstdio>
-#include <iomanip>
+#include <fstream>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 // For testing purposes:
 #define private public
+#define AX_LZW_STATS 1
 #include <lzw.hpp>
+#include <lzw_file.hpp>
+#include <lzw.h>
 
 /// @returns vector with random symbols from Dict range (dictionary)
 template <class Dict, class Ret = std::vector<typename Dict::value_type>>
@@ -21,6 +24,58 @@ Ret generate_random_vector(std::size_t length) {
     return out;
 }
 
+/// Checks {prefix, symbol} => code dictionary engine with 4 symbols alphabet
+template <class Dict>
+bool trie_dict_test() {
+    Dict dict(4);
+    std::size_t found = 0;
+    
+    // {0, 1} => 4, {4, 2} => 5
+    if(!dict.emplace(0, 1, 4, found) || !dict.emplace(4, 2, 5, found) ||
+        dict.emplace(0, 1, 6, found) || found != 4 ||
+        dict.emplace(4, 2, 6, found) || found != 5 || dict.size() != 6)
+        return false;
+    
+    // growing through several rehashes/rows
+    for(std::size_t code = 6; code < 100000; ++code)
+        dict.emplace(code - 1, code % 4, code, found);
+    
+    for(std::size_t code = 6; code < 100000; ++code)
+        if(dict.emplace(code - 1, code % 4, 0, found) || found != code)
+            return false;
+    
+    return dict.size() == 100000;
+}
+
+/// Checks table-driven lookups against recursive symbol_by_index/index_of_symbol
+template <class Dict>
+bool symbol_lookup_test() {
+    using key_type = typename std::make_unsigned<typename Dict::value_type>::type;
+    
+    for(std::size_t idx = 0; idx < Dict::length; ++idx)
+        if(Dict::symbol_at(idx) != Dict::symbol_by_index(idx) ||
+            Dict::find_index(Dict::symbol_by_index(idx)) != idx)
+            return false;
+    
+    // every value of narrow symbol type is either found or rejected
+    for(std::size_t key = 0; key <= std::size_t(key_type(~key_type(0))) && key < 65536; ++key) {
+        const auto c = typename Dict::value_type(key);
+        const std::size_t idx = Dict::find_index(c);
+        if(idx != Dict::length && Dict::symbol_by_index(idx) != c)
+            return false;
+        
+        // misses agree with ranges
+        if(idx == Dict::length) {
+            bool missed = false;
+            try { Dict::index_of_symbol(c); }
+            catch(std::out_of_range const&) { missed = true; }
+            if(!missed) return false;
+        }
+    }
+    
+    return true;
+}
+
 template <class Codec, std::size_t N>
 struct codec_test {
     
@@ -32,20 +87,33 @@ struct codec_test {
         // Bits packing
         if(1) {
             for(size_t i = 0; i < N; ++i) {
-                const size_t bit_depth = rand() % 32 + 1;
-                const size_t bit_mask = (1ULL << bit_depth) - 1ULL;
+                // wide codes are packed chunk by chunk
+                const size_t bit_depth = rand() % Codec::max_legacy_bit_depth + 1;
+                const size_t bit_mask = low_mask(bit_depth);
                 
                 codes_vec in(rand() % 1024 + 1, 0);
                 for(auto& code : in)
-                    code = (rand() % 1024) & bit_mask;
+                    code = (rand() % 2 ? (size_t(rand()) << 40) ^ (size_t(rand()) << 20) ^ rand() : rand() % 1024) & bit_mask;
                 
                 vector<typename Codec::Pack_dictionary::value_type> packed;
                 Codec::pack_bits(in, back_inserter(packed), bit_depth);
                 
+                // grown container, contiguous and generic outputs are packed the same way
+                vector<typename Codec::Pack_dictionary::value_type> by_pointer(packed.size());
+                list<typename Codec::Pack_dictionary::value_type> by_symbol;
+                Codec::pack_bits(in, by_pointer.data(), bit_depth);
+                Codec::pack_bits(in, back_inserter(by_symbol), bit_depth);
+                if(by_pointer != packed || by_symbol.size() != packed.size() ||
+                    !equal(by_symbol.begin(), by_symbol.end(), packed.begin())) {
+                    cout << "Packing outputs mismatch, bit depth " << bit_depth << endl;
+                    return false;
+                }
+                
                 codes_vec out;
-                Codec::unpack_bits(packed.begin(), packed.end(), out);
+                size_t consumed = 0;
+                const auto status = Codec::unpack_bits(packed.begin(), packed.end(), out, consumed);
                 
-                if(in != out) {
+                if(status != decode_status::ok || consumed != packed.size() || in != out) {
                     for(auto const& code : in ) cout << code << " "; cout << "\n";
                     for(auto const& code : out) cout << code << " "; cout << "\n" << endl;
                     return false;
@@ -58,98 +126,631 @@ struct codec_test {
             using src_t  = vector<typename Codec::Input_dictionary::value_type>;
             using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
             
+            // reused between messages of different lengths
+            lzw::encoder<Codec> enc_instance;
+            lzw::decoder<Codec> dec_instance;
+            
             for(size_t i = 0; i < N; ++i) {
                 const size_t length = 1 + rand() % (1 + i);
                 
                 src_t  src = generate_random_vector<typename Codec::Input_dictionary>(length);
-                pack_t enc;
-                src_t  dec;
+                pack_t enc, enc2;
+                src_t  dec, dec2;
                 
                 Codec::encode(src.begin(), src.end(), std::back_inserter(enc));
                 Codec::decode(enc.begin(), enc.end(), std::back_inserter(dec));
                 
-                if(src != dec) {
+                enc_instance.encode(src.begin(), src.end(), std::back_inserter(enc2));
+                dec_instance.decode(enc2.begin(), enc2.end(), std::back_inserter(dec2));
+                
+                if(src != dec || enc != enc2 || src != dec2) {
                     for(auto const& x : src) cout << x << " "; cout << "\n";
                     for(auto const& x : enc) cout << x << " "; cout << "\n";
                     for(auto const& x : dec) cout << x << " "; cout << "\n" << endl;
                     return false;
                 }
+                
+                // contiguous output (pointer, vector iterator), repeats produce KwKwK codes
+                src_t rep = src;
+                rep.insert(rep.end(), src.begin(), src.end());
+                rep.insert(rep.end(), length, src[0]);
+                
+                pack_t enc3;
+                Codec::encode(rep.begin(), rep.end(), std::back_inserter(enc3));
+                
+                src_t dec3(rep.size()), dec4(rep.size());
+                auto end3 = Codec::decode(enc3.begin(), enc3.end(), dec3.data());
+                auto end4 = dec_instance.decode(enc3.begin(), enc3.end(), dec4.begin());
+                
+                if(rep != dec3 || rep != dec4 || end3 != dec3.data() + dec3.size() || end4 != dec4.end()) {
+                    cout << "Contiguous decoding failed, length=" << rep.size() << endl;
+                    return false;
+                }
+                
+                // appended to non-empty container grown in place
+                src_t dec5(1, src[0]);
+                Codec::decode(enc3.begin(), enc3.end(), back_inserter(dec5));
+                if(dec5.size() != rep.size() + 1 || !equal(rep.begin(), rep.end(), dec5.begin() + 1)) {
+                    cout << "Appended decoding failed, length=" << rep.size() << endl;
+                    return false;
+                }
             }
         }
         
-        // Perf
+        // Codes wider than 16 bits: 32-bit intermediate storage
         if(1) {
-            cout << "\nPerf: PackDict::length=" << Codec::Pack_dictionary::length << endl;
+            using src_t  = vector<typename Codec::Input_dictionary::value_type>;
+            using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
             
+            // repeated half emits phrase codes, random pairs of wide alphabets are rarely linked
+            src_t src = generate_random_vector<typename Codec::Input_dictionary>(size_t(1) << 17);
+            src.insert(src.end(), src.begin(), src.end());
+            pack_t enc;
+            src_t dec, dec2(src.size());
+            
+            Codec::encode(src.begin(), src.end(), back_inserter(enc));
+            Codec::decode(enc.begin(), enc.end(), back_inserter(dec));
+            Codec::decode(enc.begin(), enc.end(), dec2.begin());
+            
+            if(src != dec || src != dec2 || Codec::Pack_dictionary::index_of_symbol(enc[0]) <= 16) {
+                cout << "Wide codes failed, length=" << src.size() << endl;
+                return false;
+            }
+        }
+        
+        // Options validation without exceptions agrees with checked options
+        if(1) {
+            for(size_t bit_depth = 0; bit_depth <= 2 * CHAR_BIT * sizeof(size_t); ++bit_depth) {
+                for(bool const checksum : {false, true}) {
+                    stream_options options;
+                    options.max_bit_depth = bit_depth;
+                    options.checksum = checksum;
+                    
+                    char const* error = Codec::options_error(options);
+                    string message;
+                    try { Codec::checked(options); }
+                    catch(std::logic_error const& e) { message = e.what(); }
+                    
+                    if(message != (error ? error : "")) {
+                        cout << "Options validation mismatch, max_bit_depth " << bit_depth << endl;
+                        return false;
+                    }
+                }
+            }
+        }
+        
+        // Streaming: chunked input, flushes, frozen dictionaries, concatenated streams
+        if(1) {
+            using src_t  = vector<typename Codec::Input_dictionary::value_type>;
+            using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
+            
+            for(size_t i = 0; i < N/10; ++i) {
+                stream_options options;
+                options.mode = (i % 4 < 2) ? code_mode::variable : code_mode::fixed;
+                if(i % 2)
+                    options.max_bit_depth = Codec::min_stream_bit_depth + rand() % 4;
+                options.policy = dict_policy(i % 3);
+                
+                stream_encoder<Codec> encoder(options);
+                src_t src;
+                pack_t enc;
+                
+                for(size_t stream = 0; stream < 2; ++stream) {
+                    for(size_t chunk = 0, chunks = rand() % 8; chunk < chunks; ++chunk) {
+                        auto part = generate_random_vector<typename Codec::Input_dictionary>(rand() % 300);
+                        if(rand() % 2) // repeated data
+                            part.insert(part.end(), part.begin(), part.end());
+                        
+                        encoder.write(part.begin(), part.end(), back_inserter(enc));
+                        if(rand() % 3 == 0)
+                            encoder.flush(back_inserter(enc));
+                        src.insert(src.end(), part.begin(), part.end());
+                    }
+                    encoder.finish(back_inserter(enc));
+                }
+                
+                // one-shot
+                src_t dec;
+                Codec::decode(enc.begin(), enc.end(), back_inserter(dec));
+                
+                // preallocated buffer, too small one is rejected
+                pack_t enc4(Codec::max_encoded_size(src.size(), options));
+                typename Codec::encode_workspace ws{options};
+                src_t dec4;
+                
+                bool rejected = false;
+                try { Codec::encode_into(src.begin(), src.end(), enc4.data(), 3, ws); }
+                catch(std::length_error const&) { rejected = true; }
+                
+                auto end4 = Codec::encode_into(src.begin(), src.end(), enc4.data(), enc4.size(), ws);
+                Codec::decode(enc4.data(), end4, back_inserter(dec4));
+                
+                if(!rejected || src != dec4) {
+                    cout << "Buffer encoding failed, length=" << src.size() << endl;
+                    return false;
+                }
+                
+                // symbol by symbol
+                stream_decoder<Codec> decoder;
+                src_t dec2;
+                for(auto const& x : enc)
+                    decoder.write(&x, &x + 1, back_inserter(dec2));
+                decoder.finish();
+                
+                // single stream at once
+                pack_t enc3;
+                src_t dec3;
+                Codec::encode(src.begin(), src.end(), back_inserter(enc3), options);
+                Codec::decode(enc3.begin(), enc3.end(), back_inserter(dec3));
+                
+                if(src != dec || src != dec2 || src != dec3) {
+                    cout << "Streaming failed, length=" << src.size() << endl;
+                    return false;
+                }
+            }
+        }
+        
+        // Seed dictionary: streams start from trained phrases, CLEAR returns to them
+        if(1) {
             using src_t  = vector<typename Codec::Input_dictionary::value_type>;
             using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
             
-            constexpr size_t sample_length = 1024;
+            auto pattern = generate_random_vector<typename Codec::Input_dictionary>(64);
+            src_t sample;
+            for(size_t i = 0; i < 64; ++i)
+                sample.insert(sample.end(), pattern.begin(), pattern.begin() + rand() % 64);
+            
+            for(size_t i = 0; i < 8; ++i) {
+                auto seed = make_shared<typename Codec::seed_dictionary const>(i, sample.begin(), sample.end(), rand() % 512);
+                
+                stream_options options;
+                options.mode = (i % 2) ? code_mode::variable : code_mode::fixed;
+                options.policy = dict_policy::reset;
+                options.max_bit_depth = log2_ceil(seed->end() + 1) + i % 2;
+                
+                src_t src = sample;
+                src.resize(rand() % sample.size());
+                auto noise = generate_random_vector<typename Codec::Input_dictionary>(rand() % 3000);
+                src.insert(src.end(), noise.begin(), noise.end());
+                
+                typename Codec::encode_workspace ews{options};
+                ews.use_seed(seed);
+                pack_t enc;
+                Codec::finish(Codec::write(src.begin(), src.end(), back_inserter(enc), ews), ews);
+                Codec::finish(Codec::write(src.begin(), src.end(), back_inserter(enc), ews), ews);
+                
+                // unknown seed id is rejected
+                bool rejected = false;
+                typename Codec::decode_workspace dws;
+                src_t dec;
+                try { Codec::decode(enc.begin(), enc.end(), back_inserter(dec), dws); }
+                catch(std::logic_error const&) { rejected = true; }
+                
+                dec.clear();
+                dws.add_seed(seed);
+                Codec::decode(enc.begin(), enc.end(), back_inserter(dec), dws);
+                
+                src.insert(src.end(), src.begin(), src.end());
+                
+                // buffer bound counts seed id and codes left after seed phrases
+                pack_t enc2(Codec::max_encoded_size(noise.size(), ews));
+                src_t dec2;
+                bool fits = true;
+                try {
+                    auto end2 = Codec::encode_into(noise.begin(), noise.end(), enc2.data(), enc2.size(), ews);
+                    Codec::decode(enc2.data(), end2, back_inserter(dec2), dws);
+                }
+                catch(std::length_error const&) { fits = false; }
+                
+                if(!rejected || src != dec || !fits || noise != dec2) {
+                    cout << "Seed dictionary failed, length=" << src.size() << endl;
+                    return false;
+                }
+            }
+        }
+        
+        // Bounded dictionary: legacy freeze, CLEAR codes on long inputs
+        if(1) {
+            using src_t  = vector<typename Codec::Input_dictionary::value_type>;
+            using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
             
-            auto perf_fun = [](src_t src){
-                using namespace std::chrono;
+            for(size_t i = 0; i < 8; ++i) {
+                // changing statistics: random parts and repeated patterns
+                src_t src;
+                for(size_t part = 0; part < 8; ++part) {
+                    auto x = generate_random_vector<typename Codec::Input_dictionary>(rand() % 64 + 1);
+                    auto len = (part % 2) ? size_t(rand() % 4096) : x.size()*(rand() % 128);
+                    for(size_t j = 0; j < len; ++j)
+                        src.push_back((part % 2) ? generate_random_vector<typename Codec::Input_dictionary>(1)[0] : x[j % x.size()]);
+                }
                 
-                const float k = 1000.f/src.size();
+                stream_options options;
+                options.policy = dict_policy(i % 3);
+                options.max_bit_depth = Codec::min_stream_bit_depth + i % 4;
                 
                 pack_t enc;
-                src_t  dec;
+                src_t dec;
+                Codec::encode(src.begin(), src.end(), back_inserter(enc), options);
+                Codec::decode(enc.begin(), enc.end(), back_inserter(dec));
                 
-                constexpr size_t M = 16;
-                using clock_t = high_resolution_clock;
-                clock_t::time_point t1, t2;
+                // legacy format with dictionary limit
+                typename Codec::encode_workspace ws{options};
+                pack_t enc2;
+                src_t dec2;
+                Codec::encode(src.begin(), src.end(), back_inserter(enc2), ws);
+                Codec::decode(enc2.begin(), enc2.end(), back_inserter(dec2));
                 
+                if(src != dec || src != dec2 || Codec::Pack_dictionary::index_of_symbol(enc2[0]) > options.max_bit_depth) {
+                    cout << "Bounded dictionary failed, length=" << src.size() << endl;
+                    return false;
+                }
+            }
+        }
+        
+        // Legacy message doesn't depend on streams written by workspace before
+        if(1) {
+            using src_t  = vector<typename Codec::Input_dictionary::value_type>;
+            using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
+            
+            src_t src = generate_random_vector<typename Codec::Input_dictionary>(N*128);
+            src_t prev = generate_random_vector<typename Codec::Input_dictionary>(N);
+            
+            typename Codec::encode_workspace fresh;
+            pack_t expected;
+            Codec::encode(src.begin(), src.end(), back_inserter(expected), fresh);
+            
+            typename Codec::encode_workspace ws, ws_default{stream_options{}};
+            for(auto* w : {&ws, &ws_default}) {
+                pack_t stream, enc;
+                Codec::finish(Codec::write(prev.begin(), prev.end(), back_inserter(stream), *w), *w);
+                Codec::encode(src.begin(), src.end(), back_inserter(enc), *w);
                 
-                t1 = clock_t::now();
-                for(size_t i = 0; i < M; ++i) {
-                    enc.clear();
-                    Codec::encode(src.begin(), src.end(), back_inserter(enc)); }
-                t2 = clock_t::now();
+                if(enc != expected) {
+                    cout << "Legacy after stream failed, length=" << src.size() << endl;
+                    return false;
+                }
+            }
+        }
+        
+        // Batch: many small messages, empty ones included, one workspace
+        if(1) {
+            using src_t  = vector<typename Codec::Input_dictionary::value_type>;
+            using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
+            
+            vector<src_t> src(N/10);
+            for(auto& msg : src)
+                msg = generate_random_vector<typename Codec::Input_dictionary>(rand() % 8 ? rand() % 256 : 0);
+            
+            typename Codec::batch_workspace ws;
+            vector<pack_t> enc(src.size());
+            vector<src_t> dec(src.size());
+            
+            auto enc_end = Codec::encode_batch(src.begin(), src.end(), enc.begin(), ws);
+            auto dec_end = Codec::decode_batch(enc.begin(), enc.end(), dec.begin(), ws);
+            
+            bool same = (enc_end == enc.end() && dec_end == dec.end() && src == dec);
+            for(size_t i = 0; same && i < src.size(); ++i) {
+                pack_t single;
+                Codec::encode(src[i].begin(), src[i].end(), back_inserter(single));
+                same = (single == enc[i]);
+            }
+            
+            if(!same) {
+                cout << "Batch failed, messages=" << src.size() << endl;
+                return false;
+            }
+        }
+        
+        // Statistics of legacy messages and streams, hooks
+        if(1) {
+            using src_t  = vector<typename Codec::Input_dictionary::value_type>;
+            using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
+            
+            src_t src = generate_random_vector<typename Codec::Input_dictionary>(N);
+            src.insert(src.end(), src.begin(), src.end());
+            
+            typename Codec::encode_workspace enc_ws{stream_options{}};
+            typename Codec::decode_workspace dec_ws;
+            
+            size_t reports = 0;
+            enc_ws.on_stats([&reports](codec_stats const&) { ++reports; });
+            dec_ws.on_stats([&reports](codec_stats const&) { ++reports; });
+            
+            for(bool legacy : {true, false}) {
+                pack_t enc;
+                src_t dec;
+                if(legacy) Codec::encode(src.begin(), src.end(), back_inserter(enc), enc_ws);
+                else Codec::finish(Codec::write(src.begin(), src.end(), back_inserter(enc), enc_ws), enc_ws);
+                Codec::decode(enc.begin(), enc.end(), back_inserter(dec), dec_ws);
                 
-                printf("LZW encode = %f us/Ksymbol\n",
-                    float(k*duration_cast<microseconds>(t2-t1).count()/M));
+                codec_stats const& e = enc_ws.stats();
+                codec_stats const& d = dec_ws.stats();
+                const size_t in_bytes  = src.size()*sizeof(typename src_t::value_type);
+                const size_t out_bytes = enc.size()*sizeof(typename pack_t::value_type);
                 
+                const bool same = (dec == src &&
+                    e.bytes_in == in_bytes && e.bytes_out == out_bytes && d.bytes_in == out_bytes && d.bytes_out == in_bytes &&
+                    e.symbols == src.size() && d.symbols == src.size() && e.phrases == d.phrases &&
+                    e.max_code == d.max_code && e.bit_depth == d.bit_depth && e.dict_size == d.dict_size &&
+                    e.probes >= src.size() - 1 && e.average_phrase_length() > 1);
                 
-                t1 = clock_t::now();
-                for(size_t i = 0; i < M; ++i) {
+                if(!same) {
+                    cout << "Statistics failed, legacy=" << legacy << endl;
+                    return false;
+                }
+            }
+            
+            if(reports != 4) {
+                cout << "Statistics hooks failed, reports=" << reports << endl;
+                return false;
+            }
+        }
+        
+        // Checksum trailer: contiguous and symbol by symbol input, length ahead, corruption
+        if(1) {
+            using src_t  = vector<typename Codec::Input_dictionary::value_type>;
+            using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
+            
+            const src_t src = generate_random_vector<typename Codec::Input_dictionary>(rand() % N + 1);
+            const list<typename src_t::value_type> src_list(src.begin(), src.end());
+            
+            stream_options options;
+            options.checksum = true;
+            
+            pack_t enc, enc_list;
+            Codec::encode(src.begin(), src.end(), back_inserter(enc), options);
+            Codec::encode(src_list.begin(), src_list.end(), back_inserter(enc_list), options);
+            
+            size_t length = 0;
+            src_t dec;
+            const bool decoded = Codec::try_decode(enc.begin(), enc.end(), back_inserter(dec)).status == decode_status::ok;
+            bool same = (decoded && dec == src && enc == enc_list && enc.size() <= Codec::max_encoded_size(src.size(), options) &&
+                Codec::decoded_size(enc.begin(), enc.end(), length) && length == src.size());
+            
+            // the first code is changed, the trailer is lost
+            pack_t bad = enc;
+            bad[3] = Codec::Pack_dictionary::symbol_by_index(Codec::Pack_dictionary::index_of_symbol(bad[3]) ^ 1);
+            same = same && Codec::try_decode(bad.begin(), bad.end(), back_inserter(dec)).status != decode_status::ok &&
+                Codec::try_decode(enc.begin(), enc.end() - 1, back_inserter(dec)).status == decode_status::truncated;
+            
+            if(!same) {
+                cout << "Checksum trailer failed, length=" << src.size() << endl;
+                return false;
+            }
+        }
+        
+        // Non-throwing decoding: corrupt and truncated messages of both formats
+        if(1) {
+            using src_t  = vector<typename Codec::Input_dictionary::value_type>;
+            using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
+            
+            const src_t src = generate_random_vector<typename Codec::Input_dictionary>(rand() % N + 2);
+            typename Codec::decode_workspace ws;
+            
+            for(bool legacy : {true, false}) {
+                pack_t enc;
+                if(legacy) Codec::encode(src.begin(), src.end(), back_inserter(enc));
+                else Codec::encode(src.begin(), src.end(), back_inserter(enc), stream_options{});
+                
+                src_t dec(src.size());
+                auto result = Codec::try_decode(enc.begin(), enc.end(), dec.begin(), ws);
+                bool same = (result && result.out == dec.end() && dec == src);
+                
+                // stream without END code
+                if(!legacy) {
                     dec.clear();
-                    Codec::decode(enc.begin(), enc.end(), back_inserter(dec)); }
-                t2 = clock_t::now();
+                    same = same && Codec::try_decode(enc.begin(), enc.end() - 1, back_inserter(dec), ws).status ==
+                        decode_status::truncated;
+                }
                 
-                printf("LZW decode = %f us/Ksymbol\n",
-                    float(k*duration_cast<microseconds>(t2-t1).count()/M));
+                // random symbols: status agrees with throwing decode, which fails with its message
+                for(size_t i = 0; same && i < 64; ++i) {
+                    pack_t bad = enc;
+                    // any value of packed type, out of Pack_dictionary too
+                    bad[rand() % bad.size()] = rand() % 2 ? typename pack_t::value_type(rand()) :
+                        Codec::Pack_dictionary::symbol_by_index(rand() % Codec::Pack_dictionary::length);
+                    bad.resize(rand() % 2 ? bad.size() : rand() % bad.size() + 1);
+                    
+                    dec.clear();
+                    const decode_status status = Codec::try_decode(bad.begin(), bad.end(), back_inserter(dec), ws).status;
+                    
+                    string message;
+                    try { Codec::decode(bad.begin(), bad.end(), back_inserter(dec), ws); }
+                    catch(std::logic_error const& e) { message = e.what(); }
+                    
+                    same = (status == decode_status::ok) == message.empty() &&
+                        (message.empty() || message == status_message(status));
+                }
                 
+                if(!same) {
+                    cout << "Non-throwing decoding failed, legacy=" << legacy << endl;
+                    return false;
+                }
+            }
+        }
+        
+        // Block container: independent blocks on threads
+        if(1) {
+            using src_t  = vector<typename Codec::Input_dictionary::value_type>;
+            using pack_t = vector<typename Codec:: Pack_dictionary::value_type>;
+            
+            for(size_t i = 0; i < 16; ++i) {
+                auto src = generate_random_vector<typename Codec::Input_dictionary>(rand() % 4096);
+                if(i % 2) // repeated data
+                    src.insert(src.end(), src.begin(), src.end());
                 
-                printf("ZIP ratio = %f (enc/src) str={", float(enc.size())/src.size());
-                for(size_t i = 0, sz = min<size_t>(src.size(), 24); i < sz; ++i)
-                    cout << " " << hex << size_t(src[i]);
-                cout << std::dec << "... }" << endl;
+                const size_t block_size = rand() % 1024 + 1;
+                const size_t threads = i % 4 + 1;
                 
+                pack_t enc;
+                block_codec<Codec>::encode(src.begin(), src.end(), back_inserter(enc), block_size, threads);
                 
-                if(src != dec) {
-                    for(auto const& x : src) cout << x << " "; cout << "\n";
-                    for(auto const& x : enc) cout << x << " "; cout << "\n";
-                    for(auto const& x : dec) cout << x << " "; cout << "\n" << endl;
+                // contiguous output is sized by the index, shorter one is rejected
+                const size_t size = block_codec<Codec>::decoded_size(enc.begin(), enc.end());
+                src_t dec, dec2(size), dec3, dec4(size);
+                block_codec<Codec>::decode(enc.begin(), enc.end(), back_inserter(dec), threads);
+                block_codec<Codec>::decode(enc.begin(), enc.end(), dec2.begin());
+                block_codec<Codec>::decode(enc.begin(), enc.end(), back_inserter(dec3), threads, i % 8 + 1);
+                auto const end4 = block_codec<Codec>::decode_into(enc.begin(), enc.end(), dec4.data(), dec4.data() + size);
+                
+                bool overflow = (size == 0);
+                if(!overflow) {
+                    try { block_codec<Codec>::decode_into(enc.begin(), enc.end(), dec4.data(), dec4.data() + size - 1); }
+                    catch(std::length_error const&) { overflow = true; }
+                }
+                
+                if(src != dec || src != dec2 || src != dec3 || src != dec4 || end4 != dec4.data() + size || !overflow) {
+                    cout << "Block container failed, length=" << src.size() << endl;
                     return false;
                 }
                 
-                return true;
-            };
+                // random access
+                if(src.empty()) continue;
+                const size_t offset = rand() % src.size();
+                const size_t length = rand() % (src.size() - offset + 1);
+                
+                src_t range;
+                block_codec<Codec>::decode_range(enc.begin(), enc.end(), offset, length, back_inserter(range), threads);
+                
+                if(!equal(range.begin(), range.end(), src.begin() + offset) || range.size() != length) {
+                    cout << "Block range failed, offset=" << offset << " length=" << length << endl;
+                    return false;
+                }
+            }
             
-            auto src = src_t(sample_length, Codec::Input_dictionary::symbol_by_index(0));
-            cout << "Empty data:" << endl;
-            if(!perf_fun(src)) return false;
+            // corrupt index: packed sizes beyond 40 symbols payload (the first one is within the index rest), overflowing sum
+            for(auto const& sizes : {vector<uint64_t>{41, 1, 1000000}, vector<uint64_t>{1, uint64_t(-1), 2}}) {
+                pack_t enc;
+                auto out = back_inserter(enc);
+                *out++ = Codec::Pack_dictionary::symbol_by_index(0);
+                *out++ = Codec::Pack_dictionary::symbol_by_index(block_codec<Codec>::block_format);
+                
+                bit_writer<typename Codec::Pack_dictionary> writer;
+                for(uint64_t const x : {uint64_t(1), uint64_t(3), uint64_t(3)})
+                    out = block_codec<Codec>::put_number(x, writer, out);
+                for(uint64_t const x : sizes)
+                    out = block_codec<Codec>::put_number(x, writer, out);
+                out = writer.flush(out);
+                enc.resize(enc.size() + 40, Codec::Pack_dictionary::symbol_by_index(1));
+                
+                size_t rejected = 0;
+                src_t dec;
+                try { block_codec<Codec>::decode(enc.begin(), enc.end(), back_inserter(dec)); }
+                catch(std::logic_error const&) { ++rejected; }
+                try { block_codec<Codec>::decode_range(enc.begin(), enc.end(), 1, 2, back_inserter(dec)); }
+                catch(std::logic_error const&) { ++rejected; }
+                
+                if(rejected != 2) {
+                    cout << "Corrupt block index accepted" << endl;
+                    return false;
+                }
+            }
             
-            src = generate_random_vector<typename Codec::Input_dictionary>(sample_length);
-            cout << "Random data:" << endl;
-            if(!perf_fun(src)) return false;
+            // huge block size: block bounds don't wrap around
+            {
+                const size_t block_size = (size_t(1) << (CHAR_BIT*sizeof(size_t) - 1)) + 1;
+                pack_t enc;
+                auto out = back_inserter(enc);
+                *out++ = Codec::Pack_dictionary::symbol_by_index(0);
+                *out++ = Codec::Pack_dictionary::symbol_by_index(block_codec<Codec>::block_format);
+                
+                bit_writer<typename Codec::Pack_dictionary> writer;
+                for(uint64_t const x : {uint64_t(block_size), uint64_t(size_t(-1)), uint64_t(2), uint64_t(1), uint64_t(1)})
+                    out = block_codec<Codec>::put_number(x, writer, out);
+                out = writer.flush(out);
+                enc.resize(enc.size() + 2, Codec::Pack_dictionary::symbol_by_index(1));
+                
+                auto first = enc.begin();
+                const auto index = block_codec<Codec>::read_index(first, enc.end());
+                if(index.blocks() != 2 || index.block_offset(1) != block_size ||
+                    index.block_offset(1) + index.block_length(1) != size_t(-1)) {
+                    cout << "Huge block size failed" << endl;
+                    return false;
+                }
+            }
+        }
+        
+        // Interleaved decoding: legacy messages stepped in turn match one by one decoding
+        if(1) {
+            using value_t = typename Codec::Input_dictionary::value_type;
+            using src_t   = vector<value_t>;
+            using pack_t  = vector<typename Codec::Pack_dictionary::value_type>;
+            using message_t = typename Codec::template interleaved_message<typename pack_t::const_iterator>;
+            
+            const size_t count = 11; // more than max_interleaved
+            vector<src_t> src(count);
+            vector<pack_t> enc(count);
+            for(size_t i = 0; i < count; ++i) {
+                src[i] = generate_random_vector<typename Codec::Input_dictionary>(i == 3 ? 0 : rand() % 2048 + 1);
+                if(i % 2) // repeated data
+                    src[i].insert(src[i].end(), src[i].begin(), src[i].end());
+                
+                if(i == 5) // extended format
+                    Codec::encode(src[i].begin(), src[i].end(), back_inserter(enc[i]), stream_options{});
+                else
+                    Codec::encode(src[i].begin(), src[i].end(), back_inserter(enc[i]));
+            }
+            enc[7].resize(enc[7].size()/2);     // truncated
+            
+            vector<src_t> dec(count);
+            vector<message_t> messages(count);
+            for(size_t i = 0; i < count; ++i) {
+                dec[i].resize(src[i].size());
+                messages[i] = {enc[i].cbegin(), enc[i].cend(), dec[i].data(), dec[i].data() + dec[i].size(), {}};
+            }
+            messages[9].d_last = messages[9].d_first + dec[9].size()/2; // output overflow
             
-            const size_t chunk_len = 16;
-            for(size_t i = 0; i < (sample_length/chunk_len) - 1; ++i)
-                for(size_t j = 0; j < chunk_len; ++j)
-                    src[(i + 1)*chunk_len + j] = src[i*chunk_len + j];
-            cout << "Repeating data (chunk_len=" << chunk_len << "):" << endl;
-            if(!perf_fun(src)) return false;
+            vector<typename Codec::decode_workspace> ws(count);
+            Codec::try_decode_interleaved(messages.data(), count, ws.data());
             
+            for(size_t i = 0; i < count; ++i) {
+                src_t expected(src[i].size());
+                typename Codec::decode_workspace ews;
+                const auto result = Codec::try_decode_into(messages[i].first, messages[i].last,
+                    expected.data(), expected.data() + (messages[i].d_last - messages[i].d_first), ews);
+                
+                const size_t written = size_t(messages[i].result.out - dec[i].data());
+                if(messages[i].result.status != result.status || written != size_t(result.out - expected.data()) ||
+                    !equal(dec[i].begin(), dec[i].begin() + written, expected.begin()) ||
+                    (i != 7 && i != 9 && (!messages[i].result || dec[i] != src[i]))) {
+                    cout << "Interleaved decoding failed, message " << i << endl;
+                    return false;
+                }
+            }
+        }
+        
+        // Automatic configuration: random data is stored, repeated data is compressed
+        if(1) {
+            using IODict = typename Codec::Input_dictionary;
+            using src_t  = vector<typename IODict::value_type>;
+            using pack_t = vector<typename Codec::Pack_dictionary::value_type>;
+            
+            for(size_t i = 0; i < 8; ++i) {
+                src_t src = generate_random_vector<IODict>(rand() % N + 1);
+                const bool repeated = i % 2;
+                if(repeated)
+                    for(size_t j = 0; j < 4; ++j)
+                        src.insert(src.end(), src.begin(), src.end());
+                
+                auto_options options;
+                options.sample = rand() % 2 ? src.size()/2 + 1 : src.size();
+                
+                typename Codec::encode_workspace ws;
+                const auto choice = Codec::auto_configure(src.begin(), src.end(), ws, options);
+                
+                pack_t enc, lzw;
+                src_t dec;
+                Codec::auto_encode(src.begin(), src.end(), back_inserter(enc), ws, options);
+                Codec::encode(src.begin(), src.end(), back_inserter(lzw));
+                Codec::decode(enc.begin(), enc.end(), back_inserter(dec));
+                
+                // literal codes expand by header and padding only
+                const size_t stored = Codec::packed_size(src.size(), log2_ceil(IODict::length));
+                if(src != dec || enc.size() > stored || enc.size() > max(lzw.size(), stored) || choice.stored == repeated) {
+                    cout << "Automatic configuration failed, length=" << src.size() << " stored=" << choice.stored << endl;
+                    return false;
+                }
+            }
         }
         
         return true;
@@ -244,6 +845,340 @@ int main() {
                   << "DEC: " << dec << std::endl;
     }
     
+    {
+        // check value of CRC32C, hardware and table paths
+        const std::string check = "123456789";
+        std::uint32_t bytewise = 0;
+        for(char c : check)
+            bytewise = crc32c_symbol(bytewise, c);
+        
+        if(crc32c(0, check.data(), check.size()) != 0xE3069283U || bytewise != 0xE3069283U ||
+            crc32c(crc32c(0, check.data(), 4), check.data() + 4, 5) != 0xE3069283U) {
+            std::cout << "CRC32C failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    {
+        if(!trie_dict_test<hash_trie_dict>() || !trie_dict_test<dense_trie_dict<4>>()) {
+            std::cout << "Encoding dictionary failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    {
+        if(!symbol_lookup_test<dictionaries::ASCII_128_common>() || !symbol_lookup_test<dictionaries::BINARY_256_common>() ||
+            !symbol_lookup_test<dictionaries::UTF16_pack>() || !symbol_lookup_test<dictionaries::URI_pack>() ||
+            !symbol_lookup_test<dictionaries::UTF16_common>()) {
+            std::cout << "Symbol lookup failed" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    {
+        using namespace std;
+        
+        // wide input alphabet: singletons are implicit, only linked phrases are stored
+        using codec = codecs::UTF16_to_binary;
+        const u16string src = u"Привет, мир! Привет 😀😀😀";
+        
+        for(bool const stream : {false, true}) {
+            vector<unsigned char> enc;
+            u16string dec;
+            if(stream) codec::encode(src.begin(), src.end(), back_inserter(enc), stream_options{});
+            else codec::encode(src.begin(), src.end(), back_inserter(enc));
+            
+            codec::decode_workspace ws;
+            codec::decode(enc.begin(), enc.end(), back_inserter(dec), ws);
+            if(dec != src || ws.dict_.entries_.size() > src.size()) {
+                cout << "Wide input alphabet failed" << endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    
+    {
+        using namespace std;
+        
+        // wide packed alphabet: symbols out of UTF16_pack are reported, not thrown
+        using codec = codecs::string_to_UTF16;
+        const string src = "TOBEORNOTTOBEORTOBEORNOT";
+        u16string legacy, stream;
+        codec::encode(src.begin(), src.end(), back_inserter(legacy));
+        codec::encode(src.begin(), src.end(), back_inserter(stream), stream_options{});
+        
+        bool reported = true;
+        try {
+            for(char16_t const bad : {char16_t(0x0001), char16_t(0x001F), char16_t(0xD800), char16_t(0xDFFF)}) {
+                // stream symbols are corrupted past [0][mode][max_bit_depth] header
+                for(size_t const part : {0, 1, 2}) {
+                    u16string corrupt = legacy, corrupt_stream = stream;
+                    corrupt[(legacy.size() - 1) * part / 2] = corrupt_stream[3 + (stream.size() - 4) * part / 2] = bad;
+                    string dec;
+                    codec::decode_workspace ws;
+                    reported = reported &&
+                        codec::try_decode(corrupt.begin(), corrupt.end(), back_inserter(dec)).status == decode_status::bad_packed_symbol &&
+                        codec::try_decode(corrupt_stream.begin(), corrupt_stream.end(), back_inserter(dec)).status == decode_status::bad_packed_symbol &&
+                        codec::try_write(corrupt_stream.begin(), corrupt_stream.end(), back_inserter(dec), ws).status == decode_status::bad_packed_symbol;
+                }
+            }
+        }
+        catch(...) { reported = false; }
+        
+        if(!reported) {
+            cout << "Wide packed alphabet failed" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    {
+        using namespace std;
+        
+        // workspace reused after a stream truncated inside its checksum trailer
+        using codec = codecs::binary_to_binary;
+        stream_options options;
+        options.checksum = true;
+        
+        const string str = "TOBEORNOTTOBEORTOBEORNOT";
+        const vector<unsigned char> text(str.begin(), str.end());
+        vector<unsigned char> enc;
+        codec::encode(text.begin(), text.end(), back_inserter(enc), options);
+        
+        codec::decode_workspace ws;
+        vector<unsigned char> dec, dec2(text.size());
+        bool reused = codec::try_decode(enc.begin(), enc.end() - 2, back_inserter(dec), ws).status == decode_status::truncated;
+        dec.clear();
+        reused = reused && codec::try_decode(enc.begin(), enc.end(), back_inserter(dec), ws).status == decode_status::ok &&
+            dec == text;
+        
+        // contiguous output (C ABI, WASM contexts)
+        reused = reused && codec::try_decode(enc.begin(), enc.end() - 2, back_inserter(dec), ws).status == decode_status::truncated &&
+            codec::try_decode_into(enc.begin(), enc.end(), dec2.data(), dec2.data() + dec2.size(), ws).status == decode_status::ok &&
+            dec2 == text;
+        
+        if(!reused) {
+            cout << "Workspace reuse after truncated trailer failed" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    {
+        using namespace std;
+        
+        // arena backed workspaces: memory is released by reset() after workspaces are gone
+        using codec = lzw_codec<dictionaries::BINARY_256_common, dictionaries::BINARY_256_common, arena_allocator<size_t>>;
+        arena memory{size_t(1) << 12};
+        
+        for(size_t i = 0; i < 4; ++i) {
+            auto src = generate_random_vector<dictionaries::BINARY_256_common>(10000);
+            src.insert(src.end(), src.begin(), src.end());
+            vector<unsigned char> enc, dec, expected;
+            
+            {
+                codec::encode_workspace ews{arena_allocator<size_t>{memory}};
+                codec::decode_workspace dws{arena_allocator<size_t>{memory}};
+                codec::encode(src.begin(), src.end(), back_inserter(enc), ews);
+                codec::decode(enc.begin(), enc.end(), back_inserter(dec), dws);
+            }
+            memory.reset();
+            
+            codecs::binary_to_binary::encode(src.begin(), src.end(), back_inserter(expected));
+            if(src != dec || enc != expected) {
+                cout << "Arena codec failed" << endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    
+    {
+        using namespace std;
+        
+        // non-greedy parses: codes are decoded by any codec of the same dictionaries
+        using dict = dictionaries::ASCII_128_common;
+        using lookahead = lzw_codec<dict, dict, allocator<size_t>, parse_strategy::lookahead>;
+        using flexible  = lzw_codec<dict, dict, allocator<size_t>, parse_strategy::flexible>;
+        
+        const char* words[] = {"lzw ", "codec ", "dictionary ", "phrase ", "code ", "decoder ", "dict"};
+        bool reparsed = false;
+        for(size_t i = 0; i < 8; ++i) {
+            string src;
+            while(src.size() < 5000*(i + 1))
+                src += words[rand() % 7];
+            
+            stream_options options;
+            options.max_bit_depth = i % 2 ? 10 : 0; // frozen dictionary
+            lookahead::encode_workspace lws{options};
+            flexible::encode_workspace fws{options};
+            codecs::string_to_string::encode_workspace gws{options};
+            
+            const list<char> input(src.begin(), src.end()); // buffered symbols
+            string greedy, enc1, enc2, dec1, dec2;
+            codecs::string_to_string::encode(src.begin(), src.end(), back_inserter(greedy), gws);
+            lookahead::encode(input.begin(), input.end(), back_inserter(enc1), lws);
+            flexible::encode(src.begin(), src.end(), back_inserter(enc2), fws);
+            codecs::string_to_string::decode(enc1.begin(), enc1.end(), back_inserter(dec1));
+            flexible::decode(enc2.begin(), enc2.end(), back_inserter(dec2));
+            
+            reparsed = reparsed || enc1 != greedy || enc2 != greedy;
+            if(src != dec1 || src != dec2) {
+                cout << "Non-greedy parse failed, length=" << src.size() << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        
+        if(!reparsed) {
+            cout << "Non-greedy parse is greedy" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    {
+        using namespace std;
+        
+        // codec choice by dry runs: codecs missing input symbols are skipped
+        string text;
+        while(text.size() < 20000)
+            text += "automatic codec choice of text ";
+        const string bad = text + char(200);
+        auto_options whole;
+        whole.sample = bad.size();
+        
+        if(choose_codec<codecs::string_to_URI, codecs::string_to_string, codecs::string_to_UTF16>(text.begin(), text.end()) == 3 ||
+            choose_codec<codecs::string_to_string>(bad.begin(), bad.end(), whole) != 1) {
+            cout << "Codec choice failed" << endl;
+            return EXIT_FAILURE;
+        }
+        
+        // symbol out of dictionary after the sample: chosen limit doesn't stay in workspace
+        using codec = codecs::string_to_string;
+        string pairs;
+        while(pairs.size() < 40000)
+            pairs += "ab";
+        auto_options bounded;
+        bounded.sample = pairs.size();
+        bounded.min_bit_depth = 9;
+        
+        codec::encode_workspace ws, fresh;
+        const auto choice = codec::auto_configure(pairs.begin(), pairs.end(), ws, bounded);
+        
+        pairs += char(200);
+        bool thrown = false;
+        string enc, expected;
+        try { codec::auto_encode(pairs.begin(), pairs.end(), back_inserter(enc), ws, bounded); }
+        catch(std::out_of_range const&) { thrown = true; }
+        
+        pairs.pop_back();
+        enc.clear();
+        codec::encode(pairs.begin(), pairs.end(), back_inserter(enc), ws);
+        codec::encode(pairs.begin(), pairs.end(), back_inserter(expected), fresh);
+        
+        if(choice.stored || choice.max_bit_depth == 0 || !thrown || enc != expected) {
+            cout << "Automatic configuration of bad input failed" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    {
+        using namespace std;
+        
+        // file round trip: parts of several streaming chunks
+        using file = file_codec<codecs::binary_to_binary>;
+        const string src_path = "lzw_test_src.bin", enc_path = "lzw_test_src.lzw", dec_path = "lzw_test_dec.bin";
+        
+        auto src = generate_random_vector<dictionaries::BINARY_256_common>(file::chunk_size/2);
+        src.insert(src.end(), src.begin(), src.end());
+        src.insert(src.end(), src.begin(), src.end());
+        ofstream(src_path, ios::binary).write(reinterpret_cast<char const*>(src.data()), streamsize(src.size()));
+        
+        file::encode(src_path, enc_path);
+        file::decode(enc_path, dec_path);
+        
+        ifstream in(dec_path, ios::binary);
+        const vector<unsigned char> dec{istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+        
+        for(auto const& path : {src_path, enc_path, dec_path})
+            remove(path.c_str());
+        
+        if(src != dec) {
+            cout << "File round trip failed" << endl;
+            return EXIT_FAILURE;
+        }
+        
+        // highly compressible file of both formats: output is buffered by chunks
+        const vector<unsigned char> zeros(file::chunk_size*8, 0);
+        for(bool legacy : {true, false}) {
+            vector<unsigned char> enc;
+            if(legacy) codecs::binary_to_binary::encode(zeros.begin(), zeros.end(), back_inserter(enc));
+            else codecs::binary_to_binary::encode(zeros.begin(), zeros.end(), back_inserter(enc), stream_options{});
+            ofstream(enc_path, ios::binary).write(reinterpret_cast<char const*>(enc.data()), streamsize(enc.size()));
+            
+            size_t largest = 0;
+            {
+                mapped_file enc_file{enc_path};
+                chunked_file dec_file{dec_path};
+                file::decode(enc_file, dec_file);
+                largest = dec_file.largest_write();
+            }
+            
+            ifstream zeros_in(dec_path, ios::binary);
+            const vector<unsigned char> zeros_dec{istreambuf_iterator<char>(zeros_in), istreambuf_iterator<char>()};
+            zeros_in.close();
+            for(auto const& path : {enc_path, dec_path})
+                remove(path.c_str());
+            
+            if(zeros_dec != zeros || enc.size() >= file::chunk_size || largest > file::chunk_size) {
+                cout << "File decoding memory failed, legacy=" << legacy << " largest=" << largest << endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    
+    {
+        using namespace std;
+        
+        // C ABI: context is reused, failures are statuses
+        lzw_ctx* ctx = lzw_ctx_create(LZW_STRING_TO_UTF16);
+        auto src = generate_random_vector<dictionaries::ASCII_128_common>(10000);
+        src.insert(src.end(), src.begin(), src.end());
+        
+        bool ok = ctx != nullptr && lzw_ctx_create(-1) == nullptr && lzw_abi_version() == LZW_ABI_VERSION;
+        for(size_t i = 0; ok && i < 3; ++i) {
+            vector<char16_t> enc(lzw_max_encoded_size(ctx, src.size()));
+            vector<char> dec(src.size());
+            size_t enc_size = 0, dec_size = 0;
+            
+            ok = lzw_encode(ctx, src.data(), src.size(), enc.data(), enc.size(), &enc_size) == LZW_OK &&
+                lzw_decode(ctx, enc.data(), enc_size, dec.data(), dec.size(), &dec_size) == LZW_OK &&
+                dec_size == src.size() && dec == src;
+            
+            // too small output: decoded prefix is written
+            ok = ok && lzw_decode(ctx, enc.data(), enc_size, dec.data(), dec.size() - 1, &dec_size) == LZW_OUTPUT_OVERFLOW &&
+                dec_size == src.size() - 1 && equal(dec.begin(), dec.end() - 1, src.begin());
+            size_t size = 0;
+            ok = ok && lzw_encode(ctx, src.data(), src.size(), enc.data(), 16, &size) == LZW_OUTPUT_OVERFLOW && size == 0;
+            
+            // NULL output of zero capacity overflows, both formats
+            vector<char16_t> legacy;
+            codecs::string_to_UTF16::encode(src.begin(), src.end(), back_inserter(legacy));
+            ok = ok && lzw_encode(ctx, src.data(), src.size(), nullptr, 0, &size) == LZW_OUTPUT_OVERFLOW && size == 0 &&
+                lzw_decode(ctx, enc.data(), enc_size, nullptr, 0, &size) == LZW_OUTPUT_OVERFLOW && size == 0 &&
+                lzw_decode(ctx, legacy.data(), legacy.size(), nullptr, 0, &size) == LZW_OUTPUT_OVERFLOW && size == 0;
+            
+            // corrupt input, bad input symbol
+            const char bad = char(200);
+            enc[0] = u'\x1F';
+            ok = ok && lzw_decode(ctx, enc.data(), enc_size, dec.data(), dec.size(), &dec_size) == LZW_BAD_PACKED_SYMBOL &&
+                lzw_encode(ctx, &bad, 1, enc.data(), enc.size(), &size) == LZW_BAD_INPUT_SYMBOL &&
+                string(lzw_status_message(LZW_BAD_CODE)) == status_message(decode_status::bad_code);
+        }
+        lzw_ctx_destroy(ctx);
+        
+        if(!ok) {
+            cout << "C ABI failed" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
     {
         using namespace std;
         
@@ -252,7 +1187,8 @@ int main() {
             codec_test<codecs::binary_to_binary, N>::run(),
             codec_test<codecs::string_to_string, N>::run(),
             codec_test<codecs::string_to_UTF16,  N>::run(),
-            codec_test<codecs::string_to_URI,    N>::run()};
+            codec_test<codecs::string_to_URI,    N>::run(),
+            codec_test<codecs::UTF16_to_binary,  N>::run()};
         
         for(size_t i = 0; i < results.size(); ++i) {
             if(!results[i]) {
@@ -0,0 +1,57 @@
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+// Default build: statistics are compiled out (AX_LZW_STATS isn't defined)
+#include <lzw.hpp>
+
+/// @returns true if every field of stats is zero
+bool zeroed(lzw::codec_stats const& stats) {
+    return stats.bytes_in == 0 && stats.bytes_out == 0 && stats.symbols == 0 && stats.phrases == 0 &&
+        stats.dict_size == 0 && stats.max_code == 0 && stats.bit_depth == 0 && stats.probes == 0 &&
+        stats.dict_seconds == 0 && stats.pack_seconds == 0;
+}
+
+int main() {
+    
+    using namespace std;
+    using namespace lzw;
+    using codec = codecs::string_to_string;
+    
+    static_assert(!details::stats_enabled, "AX_LZW_STATS is enabled");
+    
+    string src;
+    while(src.size() < 10000)
+        src += "statistics are compiled out, ";
+    
+    codec::encode_workspace enc_ws{stream_options{}};
+    codec::decode_workspace dec_ws;
+    
+    size_t reports = 0;
+    enc_ws.on_stats([&reports](codec_stats const&) { ++reports; });
+    dec_ws.on_stats([&reports](codec_stats const&) { ++reports; });
+    
+    // legacy messages and streams, throwing and non-throwing decoding
+    for(bool legacy : {true, false}) {
+        string enc, dec, dec2;
+        if(legacy) codec::encode(src.begin(), src.end(), back_inserter(enc), enc_ws);
+        else codec::finish(codec::write(src.begin(), src.end(), back_inserter(enc), enc_ws), enc_ws);
+        codec::decode(enc.begin(), enc.end(), back_inserter(dec), dec_ws);
+        const auto result = codec::try_decode(enc.begin(), enc.end(), back_inserter(dec2), dec_ws);
+        
+        if(dec != src || dec2 != src || !result ||
+            !zeroed(enc_ws.stats()) || !zeroed(dec_ws.stats())) {
+            cout << "Statistics are collected, legacy=" << legacy << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    
+    if(reports != 0) {
+        cout << "Statistics hooks are called, reports=" << reports << endl;
+        return EXIT_FAILURE;
+    }
+    
+    cout << "Statistics are off" << endl;
+    return EXIT_SUCCESS;
+}